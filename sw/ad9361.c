@@ -556,6 +556,97 @@ const char *ad9361_ensm_states[] = {
 	"rx", "rx_flush", "fdd", "fdd_flush"
 };
 
+/*
+ * Shadow copy of the register values last read from or written to each
+ * device, used by __ad9361_spi_writef() instead of reading the register back.
+ * Registers with bits changed by the device itself are never taken from the
+ * shadow (see ad9361_spi_shadow_volatile()).
+ */
+static struct {
+	uint8_t val[AD_ADDR(~0) + 1];
+	uint8_t valid[(AD_ADDR(~0) + 1) / 8];
+} ad9361_spi_shadow[2];
+
+static void ad9361_spi_shadow_set(struct spi_device *spi, uint32_t reg,
+	uint8_t val)
+{
+	reg = AD_ADDR(reg);
+	ad9361_spi_shadow[spi->id_no & 1].val[reg] = val;
+	ad9361_spi_shadow[spi->id_no & 1].valid[reg / 8] |= 1 << (reg % 8);
+}
+
+static bool ad9361_spi_shadow_volatile(uint32_t reg)
+{
+	switch (AD_ADDR(reg)) {
+	case REG_SPI_CONF:
+	case REG_START_TEMP_READING:
+	case REG_CALIBRATION_CTRL:
+	case REG_STATE:
+	case REG_QUAD_CAL_CTRL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool ad9361_spi_shadow_get(struct spi_device *spi, uint32_t reg,
+	uint8_t *val)
+{
+	reg = AD_ADDR(reg);
+	if (ad9361_spi_shadow_volatile(reg) ||
+			!(ad9361_spi_shadow[spi->id_no & 1].valid[reg / 8] & (1 << (reg % 8))))
+		return false;
+	*val = ad9361_spi_shadow[spi->id_no & 1].val[reg];
+
+	return true;
+}
+
+/**
+ * Forget all shadowed register values, e.g. after a device reset.
+ * @param spi
+ */
+void ad9361_spi_shadow_invalidate(struct spi_device *spi)
+{
+	memset(ad9361_spi_shadow[spi->id_no & 1].valid, 0,
+		sizeof(ad9361_spi_shadow[0].valid));
+}
+
+/**
+ * Start queueing SPI writes; they are sent in as few transactions as
+ * possible no later than the matching ad9361_spi_batch_end(), the next read,
+ * or the next delay. Calls may be nested.
+ * @param spi
+ */
+void ad9361_spi_batch_begin(struct spi_device *spi)
+{
+#ifdef LINUX_PLATFORM
+	spi_batch_begin(spi);
+#else
+	if (spi) {
+		// Unused variable - fix compiler warning
+	}
+#endif
+}
+
+/**
+ * Send the SPI writes queued since ad9361_spi_batch_begin().
+ * @param spi
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t ad9361_spi_batch_end(struct spi_device *spi)
+{
+#ifdef LINUX_PLATFORM
+	int32_t ret = spi_batch_end(spi);
+
+	return (ret < 0) ? ret : 0;
+#else
+	if (spi) {
+		// Unused variable - fix compiler warning
+	}
+	return 0;
+#endif
+}
+
 /**
  * SPI multiple bytes register read.
  * @param spi
@@ -583,6 +674,9 @@ int32_t ad9361_spi_readm(struct spi_device *spi, uint32_t reg,
 		dev_err(&spi->dev, "Read Error %"PRId32, ret);
 		return ret;
 	}
+	/* multi byte accesses go from reg downwards */
+	for (cmd = 0; cmd < num; cmd++)
+		ad9361_spi_shadow_set(spi, reg - cmd, rbuf[cmd]);
 #ifdef _DEBUG
 	{
 		int32_t i;
@@ -674,6 +768,10 @@ int32_t ad9361_spi_write(struct spi_device *spi,
 		dev_err(&spi->dev, "Write Error %"PRId32, ret);
 		return ret;
 	}
+	if (AD_ADDR(reg) == REG_SPI_CONF)
+		ad9361_spi_shadow_invalidate(spi);
+	else
+		ad9361_spi_shadow_set(spi, reg, buf[2]);
 
 #ifdef _DEBUG
 	dev_dbg(&spi->dev, "%s: reg 0x%"PRIX32" val 0x%X", __func__, reg, buf[2]);
@@ -700,9 +798,12 @@ int32_t __ad9361_spi_writef(struct spi_device *spi, uint32_t reg,
 	if (!mask)
 		return -EINVAL;
 
-	ret = ad9361_spi_readm(spi, reg, &buf, 1);
-	if (ret < 0)
-		return ret;
+	/* the read back would also end a write batch */
+	if (!ad9361_spi_shadow_get(spi, reg, &buf)) {
+		ret = ad9361_spi_readm(spi, reg, &buf, 1);
+		if (ret < 0)
+			return ret;
+	}
 
 	buf &= ~mask;
 	buf |= ((val << offset) & mask);
@@ -755,6 +856,8 @@ static int32_t ad9361_spi_writem(struct spi_device *spi,
 		dev_err(&spi->dev, "Write Error %"PRId32, ret);
 		return ret;
 	}
+	for (cmd = 0; cmd < num; cmd++)
+		ad9361_spi_shadow_set(spi, reg - cmd, tbuf[cmd]);
 
 #ifdef _DEBUG
 	{
@@ -872,6 +975,7 @@ int32_t ad9361_1rx1tx_channel_map(struct ad9361_rf_phy *phy, bool tx, int32_t ch
  */
 int32_t ad9361_reset(struct ad9361_rf_phy *phy)
 {
+	ad9361_spi_shadow_invalidate(phy->spi);
 	if (gpio_is_valid(phy->pdata->gpio_resetb)) {
 		gpio_set_value(phy->pdata->gpio_resetb, 0);
 		mdelay(1);
@@ -1172,6 +1276,243 @@ static int32_t ad9361_run_calibration(struct ad9361_rf_phy *phy, uint32_t mask)
 	return ad9361_check_cal_done(phy, REG_CALIBRATION_CTRL, mask, 0);
 }
 
+/**
+ * Registers holding the results of each cached calibration.
+ */
+static const struct {
+	uint32_t cal;
+	uint16_t reg;
+	uint16_t num;
+} ad9361_cal_cache_regs[] = {
+	{RX_BB_TUNE_CAL, REG_RX_BBF_R2346, 7},		/* R2346, C1..C3 */
+	{TX_BB_TUNE_CAL, REG_TX_BBF_R1, 8},		/* R1..R4, RP, C1, C2, CP */
+	{TX_QUAD_CAL, REG_TX1_OUT_1_PHASE_CORR, 16},	/* TX phase, gain, offset */
+	{TX_QUAD_CAL, REG_RX1_INPUT_A_PHASE_CORR, 18},	/* RX phase, gain, offset */
+};
+
+/**
+ * Initialize an empty calibration cache.
+ * @param cache The calibration cache.
+ * @return None.
+ */
+void ad9361_cal_cache_init(struct ad9361_cal_cache *cache)
+{
+	memset(cache, 0, sizeof(*cache));
+	cache->magic = AD9361_CAL_CACHE_MAGIC;
+	cache->version = AD9361_CAL_CACHE_VERSION;
+}
+
+/**
+ * Check whether a calibration cache (e.g. loaded from a file) was made by
+ * this version of the driver.
+ * @param cache The calibration cache.
+ * @return 1 if the cache can be used, 0 otherwise.
+ */
+int32_t ad9361_cal_cache_valid(const struct ad9361_cal_cache *cache)
+{
+	return cache->magic == AD9361_CAL_CACHE_MAGIC &&
+		cache->version == AD9361_CAL_CACHE_VERSION &&
+		cache->next < AD9361_CAL_CACHE_ENTRIES;
+}
+
+/**
+ * Hash the device configuration that calibration results depend on but
+ * that is not part of the cache entry arguments.
+ * @param phy The AD9361 state structure.
+ * @return The hash.
+ */
+static uint32_t ad9361_cal_cache_config(struct ad9361_rf_phy *phy)
+{
+	struct ad9361_phy_platform_data *pd = phy->pdata;
+	uint32_t v[8], hash = 2166136261UL;
+	uint32_t i;
+
+	v[0] = ad9361_spi_read(phy->spi, REG_PRODUCT_ID);
+	v[1] = phy->dev_sel;
+	v[2] = phy->clk_refin->rate;
+	v[3] = pd->rx2tx2 | (pd->fdd << 1) | (pd->split_gt << 2);
+	v[4] = pd->rx1tx1_mode_use_rx_num | (pd->rx1tx1_mode_use_tx_num << 8);
+	v[5] = pd->rf_rx_input_sel;
+	v[6] = pd->rf_tx_output_sel;
+	v[7] = pd->port_ctrl.pp_conf[1];
+
+	/* FNV-1a */
+	for (i = 0; i < sizeof(v); i++) {
+		hash ^= ((uint8_t *)v)[i];
+		hash *= 16777619UL;
+	}
+
+	return hash;
+}
+
+/**
+ * Drop all cached calibrations if the device configuration changed.
+ * @param phy The AD9361 state structure.
+ * @return None.
+ */
+static void ad9361_cal_cache_check(struct ad9361_rf_phy *phy)
+{
+	struct ad9361_cal_cache *cache = phy->cal_cache;
+	uint32_t config;
+
+	if (!cache)
+		return;
+
+	config = ad9361_cal_cache_config(phy);
+	if (cache->config != config || !ad9361_cal_cache_valid(cache)) {
+		ad9361_cal_cache_init(cache);
+		cache->config = config;
+		cache->dirty = 1;
+	}
+}
+
+/**
+ * Find the cache entry of a calibration.
+ * @param phy The AD9361 state structure.
+ * @param cal The calibration mask.
+ * @param args The calibration inputs (AD9361_CAL_CACHE_ARGS words).
+ * @param temp_band The temperature band (ignored if match_temp is false).
+ * @param match_temp Whether the temperature band must match.
+ * @return The entry, or NULL if there is none.
+ */
+static struct ad9361_cal_entry *ad9361_cal_cache_find(struct ad9361_rf_phy *phy,
+	uint32_t cal, const uint32_t *args, int32_t temp_band, bool match_temp)
+{
+	struct ad9361_cal_entry *e;
+	uint32_t i;
+
+	for (i = 0; i < AD9361_CAL_CACHE_ENTRIES; i++) {
+		e = &phy->cal_cache->entry[i];
+		if (e->cal == cal &&
+			!memcmp(e->args, args, sizeof(e->args)) &&
+			(!match_temp || e->temp_band == temp_band))
+			return e;
+	}
+
+	return NULL;
+}
+
+/**
+ * Get the temperature band the device is in.
+ * @param phy The AD9361 state structure.
+ * @return The temperature band.
+ */
+static int32_t ad9361_cal_temp_band(struct ad9361_rf_phy *phy)
+{
+	int32_t temp = ad9361_get_temp(phy);
+
+	return (temp >= 0) ? (temp / AD9361_CAL_TEMP_BAND) :
+		-((-temp + AD9361_CAL_TEMP_BAND - 1) / AD9361_CAL_TEMP_BAND);
+}
+
+/**
+ * Restore the results of a calibration from the cache, instead of running it.
+ * @param phy The AD9361 state structure.
+ * @param cal The calibration mask.
+ * @param args The calibration inputs (AD9361_CAL_CACHE_ARGS words).
+ * @return 0 if the results were restored, -ENOENT if they have to be
+ * 		   calibrated, negative error code otherwise.
+ */
+static int32_t ad9361_cal_cache_restore(struct ad9361_rf_phy *phy,
+	uint32_t cal, const uint32_t *args)
+{
+	struct ad9361_cal_entry *e;
+	uint32_t i, j, n = 0;
+	int32_t ret = 0;
+
+	if (!phy->cal_cache)
+		return -ENOENT;
+
+	e = ad9361_cal_cache_find(phy, cal, args, ad9361_cal_temp_band(phy), true);
+	if (!e)
+		return -ENOENT;
+
+	ad9361_spi_batch_begin(phy->spi);
+	for (i = 0; i < ARRAY_SIZE(ad9361_cal_cache_regs); i++) {
+		if (ad9361_cal_cache_regs[i].cal != cal)
+			continue;
+		for (j = 0; j < ad9361_cal_cache_regs[i].num; j++)
+			ret |= ad9361_spi_write(phy->spi,
+				ad9361_cal_cache_regs[i].reg + j, e->regs[n++]);
+	}
+	ret |= ad9361_spi_batch_end(phy->spi);
+	if (ret < 0)
+		return ret;
+
+	if (cal == TX_QUAD_CAL)
+		phy->last_tx_quad_cal_phase = e->phase;
+
+	dev_dbg(&phy->spi->dev, "%s: CAL Mask 0x%"PRIx32" restored", __func__, cal);
+
+	return 0;
+}
+
+/**
+ * Save the results of a calibration that just completed to the cache.
+ * @param phy The AD9361 state structure.
+ * @param cal The calibration mask.
+ * @param args The calibration inputs (AD9361_CAL_CACHE_ARGS words).
+ * @return None.
+ */
+static void ad9361_cal_cache_store(struct ad9361_rf_phy *phy,
+	uint32_t cal, const uint32_t *args)
+{
+	struct ad9361_cal_cache *cache = phy->cal_cache;
+	struct ad9361_cal_entry *e;
+	uint32_t i, j, n = 0;
+	int32_t val;
+
+	if (!cache)
+		return;
+
+	/* keep one entry per set of inputs, of the latest temperature band */
+	e = ad9361_cal_cache_find(phy, cal, args, 0, false);
+	if (!e) {
+		e = &cache->entry[cache->next];
+		cache->next = (cache->next + 1) % AD9361_CAL_CACHE_ENTRIES;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ad9361_cal_cache_regs); i++) {
+		if (ad9361_cal_cache_regs[i].cal != cal)
+			continue;
+		for (j = 0; j < ad9361_cal_cache_regs[i].num; j++) {
+			val = ad9361_spi_read(phy->spi, ad9361_cal_cache_regs[i].reg + j);
+			if (val < 0) {
+				e->cal = 0;
+				return;
+			}
+			e->regs[n++] = val;
+		}
+	}
+	e->cal = cal;
+	memcpy(e->args, args, sizeof(e->args));
+	e->temp_band = ad9361_cal_temp_band(phy);
+	e->phase = phy->last_tx_quad_cal_phase;
+	cache->dirty = 1;
+}
+
+/**
+ * Run a calibration, or restore its results if they are cached.
+ * @param phy The AD9361 state structure.
+ * @param mask The calibration mask.
+ * @param args The calibration inputs (AD9361_CAL_CACHE_ARGS words).
+ * @return 0 in case of success, negative error code otherwise.
+ */
+static int32_t ad9361_run_cached_calibration(struct ad9361_rf_phy *phy,
+	uint32_t mask, const uint32_t *args)
+{
+	int32_t ret = ad9361_cal_cache_restore(phy, mask, args);
+
+	if (ret != -ENOENT)
+		return ret;
+
+	ret = ad9361_run_calibration(phy, mask);
+	if (ret == 0)
+		ad9361_cal_cache_store(phy, mask, args);
+
+	return ret;
+}
+
 /**
  * Choose the right RX gain table index for the selected frequency.
  * @param freq The frequency value [Hz].
@@ -2497,6 +2838,7 @@ static int32_t ad9361_rx_bb_analog_filter_calib(struct ad9361_rf_phy *phy,
 	uint32_t bbpll_freq)
 {
 	uint32_t target;
+	uint32_t args[AD9361_CAL_CACHE_ARGS] = {0};
 	uint8_t tmp;
 	int32_t ret;
 
@@ -2504,6 +2846,8 @@ static int32_t ad9361_rx_bb_analog_filter_calib(struct ad9361_rf_phy *phy,
 		__func__, rx_bb_bw, bbpll_freq);
 
 	rx_bb_bw = clamp(rx_bb_bw, 200000UL, 28000000UL);
+	args[0] = rx_bb_bw;
+	args[1] = bbpll_freq;
 
 	/* 1.4 * BBBW * 2PI / ln(2) */
 	target = 126906UL * (rx_bb_bw / 10000UL);
@@ -2528,7 +2872,7 @@ static int32_t ad9361_rx_bb_analog_filter_calib(struct ad9361_rf_phy *phy,
 
 	/* Start the RX Baseband Filter calibration in register 0x016[7] */
 	/* Calibration is complete when register 0x016[7] self clears */
-	ret = ad9361_run_calibration(phy, RX_BB_TUNE_CAL);
+	ret = ad9361_run_cached_calibration(phy, RX_BB_TUNE_CAL, args);
 
 	/* Disable the RX baseband filter tune circuit, write 0x1E2=3, 0x1E3=3 */
 	ad9361_spi_write(phy->spi, REG_RX1_TUNE_CTRL,
@@ -2551,12 +2895,15 @@ static int32_t ad9361_tx_bb_analog_filter_calib(struct ad9361_rf_phy *phy,
 	uint32_t bbpll_freq)
 {
 	uint32_t target, txbbf_div;
+	uint32_t args[AD9361_CAL_CACHE_ARGS] = {0};
 	int32_t ret;
 
 	dev_dbg(&phy->spi->dev, "%s : tx_bb_bw %"PRIu32" bbpll_freq %"PRIu32,
 		__func__, tx_bb_bw, bbpll_freq);
 
 	tx_bb_bw = clamp(tx_bb_bw, 625000UL, 20000000UL);
+	args[0] = tx_bb_bw;
+	args[1] = bbpll_freq;
 
 	/* 1.6 * BBBW * 2PI / ln(2) */
 	target = 145036 * (tx_bb_bw / 10000UL);
@@ -2572,7 +2919,7 @@ static int32_t ad9361_tx_bb_analog_filter_calib(struct ad9361_rf_phy *phy,
 
 	/* Start the TX Baseband Filter calibration in register 0x016[6] */
 	/* Calibration is complete when register 0x016[] self clears */
-	ret = ad9361_run_calibration(phy, TX_BB_TUNE_CAL);
+	ret = ad9361_run_cached_calibration(phy, TX_BB_TUNE_CAL, args);
 
 	/* Disable the TX baseband filter tune circuit by writing 0x0CA=0x26. */
 	ad9361_spi_write(phy->spi, REG_TX_TUNE_CTRL,
@@ -2926,6 +3273,7 @@ static int32_t ad9361_tx_quad_calib(struct ad9361_rf_phy *phy,
 	uint8_t __rx_phase = 0, reg_inv_bits = 0, val, decim;
 	const uint8_t(*tab)[3];
 	uint32_t index_max, i, lpf_tia_mask;
+	uint32_t args[AD9361_CAL_CACHE_ARGS];
 
 	if (phy->cached_synth_pd[0] & TX_LO_POWER_DOWN) {
 		if (phy->pdata->lo_powerdown_managed_en) {
@@ -2951,6 +3299,16 @@ static int32_t ad9361_tx_quad_calib(struct ad9361_rf_phy *phy,
 	dev_dbg(&phy->spi->dev, "%s : bw_tx %"PRIu32" clkrf %"PRIu32" clktf %"PRIu32,
 		__func__, bw_tx, clkrf, clktf);
 
+	args[0] = bw_rx;
+	args[1] = bw_tx;
+	args[2] = clkrf;
+	args[3] = clktf;
+	args[4] = clk_get_rate(phy, phy->ref_clk_scale[TX_RFPLL]);
+	args[5] = phy->current_table | ((uint32_t)rx_phase << 8);
+	ret = ad9361_cal_cache_restore(phy, TX_QUAD_CAL, args);
+	if (ret != -ENOENT)
+		goto out_restore;
+
 	txnco_word = DIV_ROUND_CLOSEST(bw_tx * 8, clktf) - 1;
 	txnco_word = clamp_t(int, txnco_word, 0, 3);
 	rxnco_word = txnco_word;
@@ -3089,6 +3447,9 @@ static int32_t ad9361_tx_quad_calib(struct ad9361_rf_phy *phy,
 			phy->current_tx_bw_Hz);
 	}
 
+	if (ret == 0)
+		ad9361_cal_cache_store(phy, TX_QUAD_CAL, args);
+
 out_restore:
 	/* Restore synthesizer powerdown configuration */
 	if (phy->pdata->lo_powerdown_managed_en &&
@@ -5192,6 +5553,9 @@ int32_t ad9361_setup(struct ad9361_rf_phy *phy)
 	if (ret < 0)
 		return ret;
 
+	/* the temperature sensor is usable from here on */
+	ad9361_cal_cache_check(phy);
+
 	ret = ad9361_ctrl_outs_setup(phy, &pd->ctrl_outs_ctrl);
 	if (ret < 0)
 		return ret;
@@ -3287,6 +3287,38 @@ struct ad9361_fastlock {
 	struct ad9361_fastlock_entry entry[2][8];
 };
 
+/*
+ * Calibration results kept across restarts. The results of the slow
+ * calibrations (RX/TX BB filter tune, TX quadrature) are saved with the
+ * inputs they depend on and the temperature band they ran at; a calibration
+ * with the same inputs in the same band restores the saved registers instead
+ * of running. The cache has no pointers, so it can be saved and loaded as is.
+ */
+#define AD9361_CAL_CACHE_MAGIC		0x41443943	/* "AD9C" */
+#define AD9361_CAL_CACHE_VERSION	1
+#define AD9361_CAL_CACHE_ENTRIES	16
+#define AD9361_CAL_CACHE_ARGS		6
+#define AD9361_CAL_CACHE_REGS		34
+/* width of a temperature band, in ad9361_get_temp() units (milli degrees) */
+#define AD9361_CAL_TEMP_BAND		10000
+
+struct ad9361_cal_entry {
+	uint32_t	cal;		/* calibration mask, 0 if the entry is unused */
+	uint32_t	args[AD9361_CAL_CACHE_ARGS];	/* inputs of the calibration */
+	int32_t		temp_band;
+	uint32_t	phase;		/* last_tx_quad_cal_phase (TX_QUAD_CAL only) */
+	uint8_t		regs[AD9361_CAL_CACHE_REGS];
+};
+
+struct ad9361_cal_cache {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	config;		/* hash of the static device configuration */
+	uint32_t	next;		/* entry to replace next */
+	uint32_t	dirty;		/* set when an entry was added or replaced */
+	struct ad9361_cal_entry	entry[AD9361_CAL_CACHE_ENTRIES];
+};
+
 enum dig_tune_flags {
 	BE_VERBOSE = 1,
 	BE_MOREVERBOSE = 2,
@@ -3380,6 +3412,7 @@ struct ad9361_rf_phy {
 	uint32_t				bist_tone_level_dB;
 	uint32_t				bist_tone_mask;
 	bool			bbpll_initialized;
+	struct ad9361_cal_cache	*cal_cache;
 };
 
 struct refclk_scale {
@@ -3412,6 +3445,9 @@ int32_t ad9361_spi_write(struct spi_device *spi,
 	uint32_t reg, uint32_t val);
 int32_t __ad9361_spi_writef(struct spi_device *spi, uint32_t reg,
 	uint32_t mask, uint32_t offset, uint32_t val);
+void ad9361_spi_shadow_invalidate(struct spi_device *spi);
+void ad9361_spi_batch_begin(struct spi_device *spi);
+int32_t ad9361_spi_batch_end(struct spi_device *spi);
 int32_t ad9361_reset(struct ad9361_rf_phy *phy);
 int32_t register_clocks(struct ad9361_rf_phy *phy);
 int32_t ad9361_init_gain_tables(struct ad9361_rf_phy *phy);
@@ -3515,6 +3551,8 @@ int32_t ad9361_set_dcxo_tune(struct ad9361_rf_phy *phy,
 int32_t ad9361_tx_mute(struct ad9361_rf_phy *phy, uint32_t state);
 uint32_t ad9361_validate_rf_bw(struct ad9361_rf_phy *phy, uint32_t bw);
 int32_t ad9361_get_temp(struct ad9361_rf_phy *phy);
+void ad9361_cal_cache_init(struct ad9361_cal_cache *cache);
+int32_t ad9361_cal_cache_valid(const struct ad9361_cal_cache *cache);
 int ad9361_synth_lo_powerdown(struct ad9361_rf_phy *phy,
 		enum synth_pd_ctrl rx,
 		enum synth_pd_ctrl tx);
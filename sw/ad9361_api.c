@@ -427,6 +427,7 @@ int32_t ad9361_init (struct ad9361_rf_phy **ad9361_phy, AD9361_InitParam *init_p
 	phy->ad9361_rfpll_ext_recalc_rate = init_param->ad9361_rfpll_ext_recalc_rate;
 	phy->ad9361_rfpll_ext_round_rate = init_param->ad9361_rfpll_ext_round_rate;
 	phy->ad9361_rfpll_ext_set_rate = init_param->ad9361_rfpll_ext_set_rate;
+	phy->cal_cache = init_param->cal_cache;
 
 	ret = register_clocks(phy);
 	if (ret < 0)
@@ -605,9 +606,11 @@ int32_t ad9361_set_rx_rf_gain (struct ad9361_rf_phy *phy,
 	int32_t ret = 0;
 
 	rx_gain.gain_db = gain_db;
+	ad9361_spi_batch_begin(phy->spi);
 	ret = ad9361_set_rx_gain(phy,
 					ad9361_1rx1tx_channel_map(phy, false,
 					ch + 1), &rx_gain);
+	ret |= ad9361_spi_batch_end(phy->spi);
 
 	return ret;
 }
@@ -737,8 +740,10 @@ int32_t ad9361_set_rx_lo_freq (struct ad9361_rf_phy *phy,
 {
 	int32_t ret;
 
+	ad9361_spi_batch_begin(phy->spi);
 	ret = clk_set_rate(phy, phy->ref_clk_scale[RX_RFPLL],
 				ad9361_to_clk(lo_freq_hz));
+	ret |= ad9361_spi_batch_end(phy->spi);
 
 	return ret;
 }
@@ -1193,6 +1198,82 @@ int32_t ad9361_rx_fastlock_save(struct ad9361_rf_phy *phy, uint32_t profile, uin
 	return ad9361_fastlock_save(phy, 0, profile, values);
 }
 
+/**
+ * Prepare hopping the RX LO over a list of frequencies. Each frequency is
+ * tuned to once (with a full VCO calibration) and its fastlock profile saved
+ * to sweep->profiles. The LO is left at the last frequency.
+ * @param phy The AD9361 state structure.
+ * @param sweep The sweep state; sweep->profiles must hold n * 16 bytes.
+ * @param freqs_hz The frequencies (Hz).
+ * @param n The number of frequencies.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t ad9361_rx_sweep_prepare(struct ad9361_rf_phy *phy, struct ad9361_sweep *sweep,
+								const uint64_t *freqs_hz, uint32_t n)
+{
+	uint32_t i;
+	int32_t ret;
+
+	sweep->n = n;
+	sweep->loaded[0] = sweep->loaded[1] = -1;
+	sweep->active = -1;
+	for (i = 0; i < n; i++) {
+		ret = ad9361_set_rx_lo_freq(phy, freqs_hz[i]);
+		if (ret < 0)
+			return ret;
+		ret = ad9361_rx_fastlock_store(phy, 0);
+		if (ret < 0)
+			return ret;
+		ret = ad9361_rx_fastlock_save(phy, 0, &sweep->profiles[i * 16]);
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * Hop the RX LO to entry index of a sweep prepared with
+ * ad9361_rx_sweep_prepare(), then load the next entry into the other
+ * fastlock slot so that the next hop is only a recall.
+ * @param phy The AD9361 state structure.
+ * @param sweep The sweep state.
+ * @param index The entry to hop to.
+ * @return 0 in case of success, negative error code otherwise.
+ */
+int32_t ad9361_rx_sweep_hop(struct ad9361_rf_phy *phy, struct ad9361_sweep *sweep,
+							uint32_t index)
+{
+	uint32_t slot, next;
+	int32_t ret = 0;
+
+	if (index >= sweep->n)
+		return -EINVAL;
+	slot = (sweep->active < 0) ? 0 : (sweep->active ^ 1);
+	next = (index + 1) % sweep->n;
+
+	ad9361_spi_batch_begin(phy->spi);
+	if (sweep->loaded[slot] != (int32_t)index) {
+		ret |= ad9361_rx_fastlock_load(phy, slot, &sweep->profiles[index * 16]);
+		sweep->loaded[slot] = index;
+	}
+	ret |= ad9361_rx_fastlock_recall(phy, slot);
+	ret |= ad9361_spi_batch_end(phy->spi);
+	if (ret < 0)
+		return ret;
+	sweep->active = slot;
+
+	/* the other slot is not in use, so this doesn't disturb the LO */
+	if (sweep->n > 1 && sweep->loaded[slot ^ 1] != (int32_t)next) {
+		ad9361_spi_batch_begin(phy->spi);
+		ret = ad9361_rx_fastlock_load(phy, slot ^ 1, &sweep->profiles[next * 16]);
+		ret |= ad9361_spi_batch_end(phy->spi);
+		sweep->loaded[slot ^ 1] = next;
+	}
+
+	return ret;
+}
+
 /**
  * Power down the RX Local Oscillator.
  * @param phy The AD9361 state structure.
@@ -1241,9 +1322,11 @@ int32_t ad9361_set_tx_attenuation (struct ad9361_rf_phy *phy,
 	int32_t channel;
 
 	channel = ad9361_1rx1tx_channel_map(phy, true, ch);
+	ad9361_spi_batch_begin(phy->spi);
 	ret = ad9361_set_tx_atten(phy, attenuation_mdb,
 			channel == 0, channel == 1,
 			!phy->pdata->update_tx_gain_via_alert);
+	ret |= ad9361_spi_batch_end(phy->spi);
 
 	return ret;
 }
@@ -1375,8 +1458,10 @@ int32_t ad9361_set_tx_lo_freq (struct ad9361_rf_phy *phy,
 {
 	int32_t ret;
 
+	ad9361_spi_batch_begin(phy->spi);
 	ret = clk_set_rate(phy, phy->ref_clk_scale[TX_RFPLL],
 				ad9361_to_clk(lo_freq_hz));
+	ret |= ad9361_spi_batch_end(phy->spi);
 
 	return ret;
 }
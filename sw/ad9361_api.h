@@ -283,6 +283,8 @@ typedef struct
 	uint32_t	(*ad9361_rfpll_ext_recalc_rate)(struct refclk_scale *clk_priv);
 	int32_t		(*ad9361_rfpll_ext_round_rate)(struct refclk_scale *clk_priv, uint32_t rate);
 	int32_t		(*ad9361_rfpll_ext_set_rate)(struct refclk_scale *clk_priv, uint32_t rate);
+	/* Calibration cache (optional, see struct ad9361_cal_cache) */
+	struct ad9361_cal_cache	*cal_cache;
 }AD9361_InitParam;
 
 typedef struct
@@ -307,6 +309,16 @@ typedef struct
 	uint32_t	tx_bandwidth;
 }AD9361_TXFIRConfig;
 
+/* RX LO hopping over more frequencies than there are fastlock profiles; see
+ * ad9361_rx_sweep_prepare(). fastlock slots 0 and 1 are used alternately, so
+ * the next hop is always loaded ahead of time and hopping is a recall. */
+struct ad9361_sweep {
+	uint32_t	n;				/* number of frequencies */
+	uint8_t		*profiles;		/* n * 16 bytes, provided by the caller */
+	int32_t		loaded[2];		/* index loaded in slots 0 and 1, or -1 */
+	int32_t		active;			/* slot in use, or -1 */
+};
+
 enum ad9361_ensm_mode {
 	ENSM_MODE_TX,
 	ENSM_MODE_RX,
@@ -420,6 +432,12 @@ int32_t ad9361_rx_fastlock_recall(struct ad9361_rf_phy *phy, uint32_t profile);
 int32_t ad9361_rx_fastlock_load(struct ad9361_rf_phy *phy, uint32_t profile, uint8_t *values);
 /* Save RX fastlock profile. */
 int32_t ad9361_rx_fastlock_save(struct ad9361_rf_phy *phy, uint32_t profile, uint8_t *values);
+/* Prepare fastlock profiles for hopping the RX LO over a list of frequencies. */
+int32_t ad9361_rx_sweep_prepare(struct ad9361_rf_phy *phy, struct ad9361_sweep *sweep,
+								const uint64_t *freqs_hz, uint32_t n);
+/* Hop the RX LO to an entry of a prepared sweep. */
+int32_t ad9361_rx_sweep_hop(struct ad9361_rf_phy *phy, struct ad9361_sweep *sweep,
+							uint32_t index);
 /* Power down the RX Local Oscillator. */
 int32_t ad9361_rx_lo_powerdown(struct ad9361_rf_phy *phy, uint8_t option);
 /* Get the RX Local Oscillator power status. */
@@ -47,6 +47,7 @@
 /******************************************************************************/
 /********************** Macros and Constants Definitions **********************/
 /******************************************************************************/
+#define ENOENT		2	/* No such file or directory */
 #define EIO			5	/* I/O error */
 #define EAGAIN		11	/* Try again */
 #define ENOMEM		12	/* Out of memory */
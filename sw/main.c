@@ -58,6 +58,7 @@
 #endif
 #include <assert.h>
 #include <string.h>
+#include <stdio.h>
 
 
 /**
@@ -333,7 +334,9 @@ AD9361_InitParam default_init_param = {
 	/* External LO clocks */
 	nullptr,	//(*ad9361_rfpll_ext_recalc_rate)()
 	nullptr,	//(*ad9361_rfpll_ext_round_rate)()
-	nullptr	//(*ad9361_rfpll_ext_set_rate)()
+	nullptr,	//(*ad9361_rfpll_ext_set_rate)()
+	/* Calibration cache */
+	nullptr	//cal_cache (set to the loaded cache in main())
 };
 
 AD9361_RXFIRConfig rx_fir_config = {	// BPF PASSBAND 3/20 fs to 1/4 fs
@@ -392,6 +395,46 @@ struct ad9361_rf_phy *ad9361_phy_b;
 
 void spi_deinit();
 
+#ifdef AD9361_CAL_CACHE_FILE
+struct ad9361_cal_cache cal_cache;
+
+/***************************************************************************//**
+ * @brief Load the calibration cache saved by a previous run; starts with an
+ *        empty cache if there is none or it is from another driver version.
+*******************************************************************************/
+void cal_cache_load(void)
+{
+	FILE *f = fopen(AD9361_CAL_CACHE_FILE, "rb");
+
+	if (!f || fread(&cal_cache, sizeof(cal_cache), 1, f) != 1 ||
+			!ad9361_cal_cache_valid(&cal_cache))
+		ad9361_cal_cache_init(&cal_cache);
+	if (f)
+		fclose(f);
+	cal_cache.dirty = 0;
+}
+
+/***************************************************************************//**
+ * @brief Save the calibration cache if calibrations were added to it. The
+ *        file is replaced atomically, so a crash never leaves a torn cache.
+*******************************************************************************/
+void cal_cache_save(void)
+{
+	const char *tmp = AD9361_CAL_CACHE_FILE ".tmp";
+	FILE *f;
+
+	if (!cal_cache.dirty)
+		return;
+	cal_cache.dirty = 0;
+	f = fopen(tmp, "wb");
+	if (!f || fwrite(&cal_cache, sizeof(cal_cache), 1, f) != 1 ||
+			fclose(f) != 0 || rename(tmp, AD9361_CAL_CACHE_FILE) != 0) {
+		printf("could not save calibration cache to %s\n", AD9361_CAL_CACHE_FILE);
+		return;
+	}
+}
+#endif
+
 /***************************************************************************//**
  * @brief main
 *******************************************************************************/
@@ -445,6 +488,11 @@ int main(void)
 	default_init_param.rf_rx_bandwidth_hz = 20000 * 1000L;
 	default_init_param.rf_tx_bandwidth_hz = 20000 * 1000L;
 	
+#ifdef AD9361_CAL_CACHE_FILE
+	cal_cache_load();
+	default_init_param.cal_cache = &cal_cache;
+#endif
+
 	if(ad9361_init(&ad9361_phy, &default_init_param) < 0) {
 		printf("ad9361_init failed\n");
 		return 1;
@@ -464,6 +512,11 @@ int main(void)
 	assert(ad9361_spi_writef(ad9361_phy->spi, REG_GPO_FORCE_AND_INIT,
 		(1 << 4) << SDR5_AD9361_GPO_PA24_EN, 1) == 0);
 
+#ifdef AD9361_CAL_CACHE_FILE
+	// all initial calibrations have run by now
+	cal_cache_save();
+#endif
+
 
 
 	//assert(ad9361_set_trx_fir_en_dis(ad9361_phy, ENABLE) >= 0);
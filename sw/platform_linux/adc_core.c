@@ -42,6 +42,7 @@
 /******************************************************************************/
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "adc_core.h"
 #include "parameters.h"
 #include "../util.h"
@@ -51,6 +52,7 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <poll.h>
 #include <stdio.h>
 
 /******************************************************************************/
@@ -152,6 +154,67 @@ int32_t get_file_info(const char *filename, uint32_t *info)
 	return 0;
 }
 
+#ifdef DMA_UIO
+/***************************************************************************//**
+ * @brief Bytes per sample of all enabled channels, as written by the DMA.
+ *
+ * @return The sample size.
+*******************************************************************************/
+static uint32_t adc_sample_bytes(void)
+{
+#ifdef FMCOMMS5
+	return 16;
+#else
+	return adc_st.rx2tx2 ? 8 : 4;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief Re-enables the rx dma interrupt, which the UIO driver disables every
+ *        time it fires.
+ *
+ * @return 0 in case of success, negative error code otherwise (e.g. if the UIO
+ *         device has no interrupt).
+*******************************************************************************/
+static int32_t adc_dma_irq_enable(void)
+{
+	uint32_t enable = 1;
+
+	if (write(rx_dma_uio_fd, &enable, sizeof(enable)) != sizeof(enable))
+		return -1;
+
+	return 0;
+}
+
+/***************************************************************************//**
+ * @brief Waits for the rx dma interrupt.
+ *
+ * @param timeout_ms The timeout in milliseconds, or -1 to wait forever.
+ *
+ * @return 1 if the interrupt fired, 0 on timeout, negative error code
+ *         otherwise.
+*******************************************************************************/
+static int32_t adc_dma_irq_wait(int32_t timeout_ms)
+{
+	struct pollfd pfd;
+	uint32_t count;
+	int32_t ret;
+
+	pfd.fd = rx_dma_uio_fd;
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, timeout_ms);
+	if (ret < 0)
+		return (errno == EINTR) ? 0 : -1;
+	if (ret == 0)
+		return 0;
+	/* Consumes the event; count is the total number of interrupts. */
+	if (read(rx_dma_uio_fd, &count, sizeof(count)) != sizeof(count))
+		return -1;
+
+	return 1;
+}
+#endif
+
 /***************************************************************************//**
  * @brief adc_init
 *******************************************************************************/
@@ -227,23 +290,13 @@ int32_t adc_capture(uint32_t size, uint32_t start_address)
 	uint32_t reg_val;
 	uint32_t transfer_id;
 	uint32_t length;
+	bool irq;
 
 	get_file_info(RX_BUFF_MEM_SIZE, &rx_buff_mem_size);
 	get_file_info(RX_BUFF_MEM_ADDR, &rx_buff_mem_addr);
 	start_address = rx_buff_mem_addr;
 
-	if(adc_st.rx2tx2)
-	{
-		length = (size * 8);
-	}
-	else
-	{
-		length = (size * 4);
-	}
-
-#ifdef FMCOMMS5
-	length = (size * 16);
-#endif
+	length = size * adc_sample_bytes();
 
 	if(length > rx_buff_mem_size) {
 		printf("%s: Desired length (%d) is bigger than the buffer size (%d).", __func__, length, rx_buff_mem_size);
@@ -264,6 +317,10 @@ int32_t adc_capture(uint32_t size, uint32_t start_address)
 	adc_dma_write(AXI_DMAC_REG_X_LENGTH, length - 1);
 	adc_dma_write(AXI_DMAC_REG_Y_LENGTH, 0x0);
 
+	/* Sleep on the end of transfer interrupt if the UIO device has one,
+	 * poll otherwise. */
+	irq = (adc_dma_irq_enable() == 0);
+
 	adc_dma_write(AXI_DMAC_REG_START_TRANSFER, 0x1);
 	/* Wait until the new transfer is queued. */
 	do {
@@ -272,10 +329,15 @@ int32_t adc_capture(uint32_t size, uint32_t start_address)
 	while(reg_val == 1);
 
 	/* Wait until the current transfer is completed. */
-	do {
+	while(1) {
 		adc_dma_read(AXI_DMAC_REG_IRQ_PENDING, &reg_val);
+		if (reg_val == (AXI_DMAC_IRQ_SOT | AXI_DMAC_IRQ_EOT))
+			break;
+		/* The timeout covers an interrupt that fired for the start of
+		 * the transfer, which only re-enabling the interrupt clears. */
+		if (irq && adc_dma_irq_wait(100) > 0)
+			adc_dma_irq_enable();
 	}
-	while(reg_val != (AXI_DMAC_IRQ_SOT | AXI_DMAC_IRQ_EOT));
 	adc_dma_write(AXI_DMAC_REG_IRQ_PENDING, reg_val);
 
 	/* Wait until the transfer with the ID transfer_id is completed. */
@@ -461,6 +523,408 @@ int32_t adc_capture_save_file(uint32_t size, uint32_t start_address,
 	return 0;
 }
 
+#ifdef DMA_UIO
+/***************************************************************************//**
+ * @brief Queues free blocks of a stream to the DMA, in ring order, until the
+ *        DMA queue is full.
+ *
+ * @param stream The stream.
+ *
+ * @return None.
+*******************************************************************************/
+static void adc_stream_submit(struct adc_stream *stream)
+{
+	uint32_t max_queued;
+	uint32_t reg_val;
+	uint32_t block;
+
+	max_queued = min(stream->num_blocks, AXI_DMAC_MAX_QUEUED);
+	while ((stream->queued < max_queued) &&
+	       (stream->completed + stream->queued < stream->num_blocks)) {
+		adc_dma_read(AXI_DMAC_REG_START_TRANSFER, &reg_val);
+		if (reg_val)
+			break;
+		block = (stream->head + stream->completed + stream->queued) %
+			stream->num_blocks;
+		adc_dma_read(AXI_DMAC_REG_TRANSFER_ID, &stream->transfer_id[block]);
+		adc_dma_write(AXI_DMAC_REG_DEST_ADDRESS,
+			      stream->buff_phys + block * stream->block_bytes);
+		adc_dma_write(AXI_DMAC_REG_DEST_STRIDE, 0x0);
+		adc_dma_write(AXI_DMAC_REG_X_LENGTH, stream->block_bytes - 1);
+		adc_dma_write(AXI_DMAC_REG_Y_LENGTH, 0x0);
+		adc_dma_write(AXI_DMAC_REG_FLAGS, 0x0);
+		adc_dma_write(AXI_DMAC_REG_START_TRANSFER, 0x1);
+		stream->queued++;
+	}
+}
+
+/***************************************************************************//**
+ * @brief Handles a dma interrupt of a stream: collects the completed blocks,
+ *        requeues the DMA and passes the blocks to the callback.
+ *
+ * @param stream The stream.
+ *
+ * @return 0 in case of success, 1 if the callback asked to stop.
+*******************************************************************************/
+static int32_t adc_stream_process(struct adc_stream *stream)
+{
+	uint32_t reg_val;
+	uint32_t block;
+	int32_t ret = 0;
+
+	adc_dma_read(AXI_DMAC_REG_IRQ_PENDING, &reg_val);
+	adc_dma_write(AXI_DMAC_REG_IRQ_PENDING, reg_val);
+	adc_dma_irq_enable();
+
+	/* Transfers complete in the order they were queued. */
+	adc_dma_read(AXI_DMAC_REG_TRANSFER_DONE, &reg_val);
+	while (stream->queued) {
+		block = (stream->head + stream->completed) % stream->num_blocks;
+		if (!(reg_val & (1 << stream->transfer_id[block])))
+			break;
+		stream->completed++;
+		stream->queued--;
+	}
+	/* Nothing was left queued, so the DMA stopped and samples were lost. */
+	if (stream->completed && !stream->queued)
+		stream->overruns++;
+
+	/* Keep the DMA busy while the callback runs. */
+	adc_stream_submit(stream);
+	while (stream->completed && !ret) {
+		ret = stream->cb(stream->ctx,
+				 stream->buff + stream->head * stream->block_bytes,
+				 stream->block_bytes, stream->seq++) ? 1 : 0;
+		stream->head = (stream->head + 1) % stream->num_blocks;
+		stream->completed--;
+		adc_stream_submit(stream);
+	}
+
+	return ret;
+}
+#endif
+
+/***************************************************************************//**
+ * @brief Starts a continuous capture into a ring of blocks in the rx dma
+ *        buffer. Every block is passed to cb as soon as the DMA completes it
+ *        and is then queued again, so as long as the callbacks keep up,
+ *        consecutive blocks are contiguous in time. Completion is signaled by
+ *        the dma interrupt through the UIO device; see adc_stream_wait().
+ *
+ * @param stream The stream state.
+ * @param block_size The number of samples per block.
+ * @param num_blocks The number of blocks in the ring (ADC_STREAM_MAX_BLOCKS at
+ *                   most). Up to AXI_DMAC_MAX_QUEUED of them are queued, so
+ *                   the callback has that many blocks of time to return.
+ * @param cb The callback for completed blocks.
+ * @param ctx The first argument of cb.
+ *
+ * @return 0 in case of success, negative error code otherwise.
+*******************************************************************************/
+int32_t adc_stream_start(struct adc_stream *stream, uint32_t block_size,
+			 uint32_t num_blocks, adc_stream_cb cb, void *ctx)
+{
+#ifdef DMA_UIO
+	uint32_t reg_val;
+	void *mapping_addr;
+
+	if (!block_size || (num_blocks < 2) ||
+	    (num_blocks > ADC_STREAM_MAX_BLOCKS) || !cb) {
+		printf("%s: Invalid block size or number of blocks.\n", __func__);
+		return -1;
+	}
+
+	get_file_info(RX_BUFF_MEM_SIZE, &rx_buff_mem_size);
+	get_file_info(RX_BUFF_MEM_ADDR, &rx_buff_mem_addr);
+
+	stream->block_bytes = block_size * adc_sample_bytes();
+	/* Keeps every block aligned to the DMA bus width. */
+	if (stream->block_bytes % 64) {
+		printf("%s: Block size (%d) must be a multiple of 64 bytes.\n",
+		       __func__, stream->block_bytes);
+		return -1;
+	}
+	if ((uint64_t)stream->block_bytes * num_blocks > rx_buff_mem_size) {
+		printf("%s: Desired length (%d) is bigger than the buffer size (%d).\n",
+		       __func__, stream->block_bytes * num_blocks, rx_buff_mem_size);
+		return -1;
+	}
+
+	if (adc_dma_irq_enable() < 0) {
+		printf("%s: rx_dma_uio device has no interrupt.\n", __func__);
+		return -1;
+	}
+
+	/* The second map of the UIO device is the buffer. */
+	mapping_addr = mmap(NULL,
+			    rx_buff_mem_size,
+			    PROT_READ | PROT_WRITE,
+			    MAP_SHARED,
+			    rx_dma_uio_fd,
+			    1 * sysconf(_SC_PAGESIZE));
+	if (mapping_addr == MAP_FAILED) {
+		printf("%s: mmap error\n\r", __func__);
+		return -1;
+	}
+
+	stream->buff = mapping_addr;
+	stream->buff_phys = rx_buff_mem_addr;
+	stream->buff_size = rx_buff_mem_size;
+	stream->num_blocks = num_blocks;
+	stream->cb = cb;
+	stream->ctx = ctx;
+	stream->head = 0;
+	stream->completed = 0;
+	stream->queued = 0;
+	stream->seq = 0;
+	stream->overruns = 0;
+
+	adc_dma_write(AXI_DMAC_REG_CTRL, 0x0);
+	adc_dma_write(AXI_DMAC_REG_CTRL, AXI_DMAC_CTRL_ENABLE);
+
+	/* Only the end of transfer interrupt. */
+	adc_dma_write(AXI_DMAC_REG_IRQ_MASK, AXI_DMAC_IRQ_SOT);
+	adc_dma_read(AXI_DMAC_REG_IRQ_PENDING, &reg_val);
+	adc_dma_write(AXI_DMAC_REG_IRQ_PENDING, reg_val);
+
+	adc_stream_submit(stream);
+
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief The file descriptor that becomes readable (POLLIN) when blocks of a
+ *        stream complete, for use in an existing poll() loop. Call
+ *        adc_stream_wait() with a timeout of 0 once it is readable.
+ *
+ * @param stream The stream.
+ *
+ * @return The file descriptor, or negative error code.
+*******************************************************************************/
+int32_t adc_stream_fd(struct adc_stream *stream)
+{
+	(void)stream;
+#ifdef DMA_UIO
+	return rx_dma_uio_fd;
+#else
+	return -1;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief Waits for blocks of a stream to complete and passes them to the
+ *        callback.
+ *
+ * @param stream The stream.
+ * @param timeout_ms The timeout in milliseconds, or -1 to wait forever.
+ *
+ * @return 0 in case of success or timeout, 1 if the callback asked to stop,
+ *         negative error code otherwise.
+*******************************************************************************/
+int32_t adc_stream_wait(struct adc_stream *stream, int32_t timeout_ms)
+{
+#ifdef DMA_UIO
+	int32_t ret;
+
+	ret = adc_dma_irq_wait(timeout_ms);
+	if (ret <= 0)
+		return ret;
+
+	return adc_stream_process(stream);
+#else
+	return -1;
+#endif
+}
+
+/***************************************************************************//**
+ * @brief Passes the blocks of a stream to the callback until it asks to stop.
+ *
+ * @param stream The stream.
+ *
+ * @return 0 in case of success, negative error code otherwise.
+*******************************************************************************/
+int32_t adc_stream_run(struct adc_stream *stream)
+{
+	int32_t ret;
+
+	do {
+		ret = adc_stream_wait(stream, -1);
+	} while (ret == 0);
+
+	return (ret < 0) ? ret : 0;
+}
+
+/***************************************************************************//**
+ * @brief Stops a stream; blocks in flight are dropped.
+ *
+ * @param stream The stream.
+ *
+ * @return None.
+*******************************************************************************/
+void adc_stream_stop(struct adc_stream *stream)
+{
+#ifdef DMA_UIO
+	uint32_t reg_val;
+
+	adc_dma_write(AXI_DMAC_REG_CTRL, 0x0);
+	adc_dma_write(AXI_DMAC_REG_IRQ_MASK, AXI_DMAC_IRQ_SOT | AXI_DMAC_IRQ_EOT);
+	adc_dma_read(AXI_DMAC_REG_IRQ_PENDING, &reg_val);
+	adc_dma_write(AXI_DMAC_REG_IRQ_PENDING, reg_val);
+
+	munmap(stream->buff, stream->buff_size);
+	stream->buff = NULL;
+	stream->completed = 0;
+	stream->queued = 0;
+#endif
+}
+
+#ifdef DMA_UIO
+struct adc_stream_save_state
+{
+	FILE *f;
+	uint8_t bin_file;
+	uint8_t ch_no;
+	/* 32 bit words (one per channel) per sample */
+	uint32_t words;
+	uint64_t remaining;
+	/* Cached copy of the block being written. */
+	uint32_t *copy;
+	int32_t error;
+};
+
+/***************************************************************************//**
+ * @brief adc_stream_cb of adc_stream_save_file(): writes one block.
+*******************************************************************************/
+static int32_t adc_stream_save_block(void *ctx, const void *data,
+				     uint32_t length, uint64_t seq)
+{
+	struct adc_stream_save_state *st = (struct adc_stream_save_state *)ctx;
+	uint32_t samples;
+	uint32_t index;
+	uint32_t ch;
+	uint32_t *src;
+	uint32_t *dst;
+
+	(void)seq;
+	samples = length / (st->words * 4);
+	if (samples > st->remaining)
+		samples = st->remaining;
+
+	if (st->bin_file && (st->ch_no == st->words)) {
+		/* Same layout as the DMA writes it: one write per block. */
+		if (fwrite(data, st->words * 4, samples, st->f) != samples)
+			st->error = -1;
+	} else {
+		/* The dma buffer is uncached; read it once, sequentially. */
+		memcpy(st->copy, data, samples * st->words * 4);
+		if (st->bin_file) {
+			src = st->copy;
+			dst = st->copy;
+			for (index = 0; index < samples; index++) {
+				for (ch = 0; ch < st->ch_no; ch++)
+					*dst++ = src[ch];
+				src += st->words;
+			}
+			if (fwrite(st->copy, st->ch_no * 4, samples, st->f) != samples)
+				st->error = -1;
+		} else {
+			src = st->copy;
+			for (index = 0; index < samples; index++) {
+				for (ch = 0; ch < st->ch_no; ch++)
+					fprintf(st->f, ch ? ",%d,%d" : "%d,%d",
+						src[ch] & 0xFFFF, (src[ch] >> 16) & 0xFFFF);
+				fputc('\n', st->f);
+				src += st->words;
+			}
+			if (ferror(st->f))
+				st->error = -1;
+		}
+	}
+	st->remaining -= samples;
+
+	return (st->error || !st->remaining) ? 1 : 0;
+}
+#endif
+
+/***************************************************************************//**
+ * @brief Captures to a file continuously, for captures longer than the rx dma
+ *        buffer. The DMA fills the next blocks of a stream (see
+ *        adc_stream_start()) while each completed block is written, in the
+ *        same formats as adc_capture_save_file().
+ *
+ * @param block_size The number of samples per block; bigger blocks give the
+ *                   writes more slack.
+ * @param size The number of samples to capture.
+ * @param filename The output file.
+ * @param bin_file 1 for a raw binary file, 0 for text.
+ * @param ch_no The number of channels to save.
+ *
+ * @return 0 in case of success, negative error code otherwise (including when
+ *         samples were lost because the writes did not keep up).
+*******************************************************************************/
+int32_t adc_stream_save_file(uint32_t block_size, uint64_t size,
+			     const char *filename, uint8_t bin_file,
+			     uint8_t ch_no)
+{
+#ifdef DMA_UIO
+	struct adc_stream_save_state st;
+	struct adc_stream stream;
+	char *file_buff;
+	int32_t ret;
+
+	st.words = adc_sample_bytes() / 4;
+	st.bin_file = bin_file;
+	st.ch_no = min(max(ch_no, 1), st.words);
+	st.remaining = size;
+	st.error = 0;
+	st.copy = (uint32_t *)malloc(block_size * adc_sample_bytes());
+	/* Big enough that stdio writes whole blocks of the binary format. */
+	file_buff = (char *)malloc(block_size * adc_sample_bytes());
+	if (!st.copy || !file_buff) {
+		free(st.copy);
+		free(file_buff);
+		return -1;
+	}
+
+	st.f = fopen(filename, bin_file ? "wb" : "w");
+	if (st.f == NULL) {
+		printf("%s: File %s cannot be opened.\n", __func__, filename);
+		free(st.copy);
+		free(file_buff);
+		return -1;
+	}
+	setvbuf(st.f, file_buff, _IOFBF, block_size * adc_sample_bytes());
+
+	ret = adc_stream_start(&stream, block_size, AXI_DMAC_MAX_QUEUED,
+			       adc_stream_save_block, &st);
+	if (ret == 0) {
+		ret = adc_stream_run(&stream);
+		adc_stream_stop(&stream);
+		if (stream.overruns) {
+			printf("%s: Samples lost %d times, writing %s did not keep up.\n",
+			       __func__, stream.overruns, filename);
+			ret = -1;
+		}
+	}
+	if (st.error) {
+		printf("%s: Writing %s failed.\n", __func__, filename);
+		ret = -1;
+	}
+
+	if (fclose(st.f) != 0)
+		ret = -1;
+	free(st.copy);
+	free(file_buff);
+
+	return ret;
+#else
+	return -1;
+#endif
+}
+
 /***************************************************************************//**
  * @brief adc_set_calib_scale_phase
 *******************************************************************************/
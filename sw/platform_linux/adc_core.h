@@ -143,11 +143,46 @@
 #define AXI_DMAC_IRQ_SOT				(1 << 0)
 #define AXI_DMAC_IRQ_EOT				(1 << 1)
 
+/* Transfer IDs are 2 bits wide, so at most 4 transfers can be in flight. */
+#define AXI_DMAC_MAX_QUEUED				4
+
+#define ADC_STREAM_MAX_BLOCKS			32
+
 struct adc_state
 {
 	bool rx2tx2;
 };
 
+/**
+ * Called for every completed block of a stream, in order. seq counts the
+ * blocks since adc_stream_start(); the block is resubmitted to the DMA once
+ * the callback returns, so data is only valid until then. A non-zero return
+ * value stops adc_stream_run().
+ */
+typedef int32_t (*adc_stream_cb)(void *ctx, const void *data,
+				 uint32_t length, uint64_t seq);
+
+struct adc_stream
+{
+	/* Virtual and physical address of the first block. */
+	void *buff;
+	uint32_t buff_phys;
+	uint32_t buff_size;
+	uint32_t block_bytes;
+	uint32_t num_blocks;
+	adc_stream_cb cb;
+	void *ctx;
+	/* Oldest block not yet passed to cb; from there on the ring holds the
+	 * completed blocks, then the blocks in flight, then the free ones. */
+	uint32_t head;
+	uint32_t completed;
+	uint32_t queued;
+	uint32_t transfer_id[ADC_STREAM_MAX_BLOCKS];
+	uint64_t seq;
+	/* Times the DMA ran out of queued blocks, i.e. samples were lost. */
+	uint32_t overruns;
+};
+
 /******************************************************************************/
 /************************ Functions Declarations ******************************/
 /******************************************************************************/
@@ -159,6 +194,15 @@ int32_t adc_capture_save_file(uint32_t size, uint32_t start_address,
 			  const char * filename, uint8_t bin_file,
 			  uint8_t ch_no);
 int32_t get_file_info(const char *filename, uint32_t *info);
+int32_t adc_stream_start(struct adc_stream *stream, uint32_t block_size,
+			 uint32_t num_blocks, adc_stream_cb cb, void *ctx);
+int32_t adc_stream_fd(struct adc_stream *stream);
+int32_t adc_stream_wait(struct adc_stream *stream, int32_t timeout_ms);
+int32_t adc_stream_run(struct adc_stream *stream);
+void adc_stream_stop(struct adc_stream *stream);
+int32_t adc_stream_save_file(uint32_t block_size, uint64_t size,
+			     const char *filename, uint8_t bin_file,
+			     uint8_t ch_no);
 int32_t adc_set_calib_scale(struct ad9361_rf_phy *phy,
 							uint32_t chan,
 							int32_t val,
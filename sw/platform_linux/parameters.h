@@ -78,4 +78,7 @@
 #define AD9361_B_UIO_ADDR		"/sys/class/uio/uio3/maps/map0/addr"
 #define SPIDEV_B_DEV			"/dev/spidev32766.1"
 
+/* calibration results kept across restarts (see struct ad9361_cal_cache) */
+#define AD9361_CAL_CACHE_FILE		"/var/lib/ad9361/cal_cache.bin"
+
 #endif // __PARAMETERS_H__
@@ -48,6 +48,7 @@
 #include "dac_core.h"
 
 #include <fcntl.h>
+#include <string.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
@@ -139,6 +140,96 @@ int32_t spi_init(uint32_t device_id,
 
 
 
+/*
+ * SPI transaction batching: between spi_batch_begin() and spi_batch_end(),
+ * writes are queued and sent together as one SPI_IOC_MESSAGE, one transfer
+ * (and chip select assertion) per register command. A read is appended to the
+ * queued writes and sent with them, and udelay()/mdelay() send the queue
+ * before sleeping, so the order and timing of accesses seen by the device
+ * are the same as without batching.
+ */
+#define SPI_BATCH_MAX_XFERS	64
+#define SPI_BATCH_MAX_BYTES	1024
+
+struct spi_batch {
+	int depth;
+	unsigned n_xfers;
+	unsigned n_bytes;
+	struct spi_ioc_transfer xfers[SPI_BATCH_MAX_XFERS];
+	unsigned char buf[SPI_BATCH_MAX_BYTES];
+};
+
+static struct spi_batch spi_batches[2];
+
+static int spi_fd(uint8_t id_no)
+{
+#ifdef FMCOMMS5
+	if (id_no != 0)
+		return spidev_b_fd;
+#else
+	if (id_no != 0)
+		return -1;
+#endif
+	return spidev_fd;
+}
+
+/***************************************************************************//**
+ * @brief spi_batch_send
+*******************************************************************************/
+static int spi_batch_send(uint8_t id_no)
+{
+	struct spi_batch *b = &spi_batches[id_no];
+	int ret = 0;
+
+	if (b->n_xfers == 0)
+		return 0;
+	/* the last transfer of every command deasserts chip select, except
+	 * for the last one of the message, which does so anyway */
+	b->xfers[b->n_xfers - 1].cs_change = 0;
+	if (spi_fd(id_no) >= 0)
+		ret = ioctl(spi_fd(id_no), SPI_IOC_MESSAGE(b->n_xfers), b->xfers);
+	b->n_xfers = 0;
+	b->n_bytes = 0;
+	if (ret < 0) {
+		printf("%s: Can't send spi message\n\r", __func__);
+		return -EIO;
+	}
+
+	return ret;
+}
+
+/***************************************************************************//**
+ * @brief spi_batch_flush_all
+*******************************************************************************/
+static void spi_batch_flush_all(void)
+{
+	uint8_t id_no;
+
+	for (id_no = 0; id_no < 2; id_no++)
+		spi_batch_send(id_no);
+}
+
+/***************************************************************************//**
+ * @brief spi_batch_begin
+*******************************************************************************/
+void spi_batch_begin(struct spi_device *spi)
+{
+	spi_batches[spi->id_no & 1].depth++;
+}
+
+/***************************************************************************//**
+ * @brief spi_batch_end
+*******************************************************************************/
+int spi_batch_end(struct spi_device *spi)
+{
+	struct spi_batch *b = &spi_batches[spi->id_no & 1];
+
+	if (b->depth > 0 && --b->depth > 0)
+		return 0;
+
+	return spi_batch_send(spi->id_no & 1);
+}
+
 /***************************************************************************//**
  * @brief spi_write_then_read
 *******************************************************************************/
@@ -146,39 +237,44 @@ int spi_write_then_read(struct spi_device *spi,
 		const unsigned char *txbuf, unsigned n_tx,
 		unsigned char *rxbuf, unsigned n_rx)
 {
-	int ret = 0;
+	struct spi_batch *b = &spi_batches[spi->id_no & 1];
+	struct spi_ioc_transfer *tr;
+	int ret;
 
-	if (spi) {
-		// Unused variable - fix compiler warning
+	/* make room; a command that doesn't fit in an empty batch is sent alone */
+	if (b->n_xfers + 2 > SPI_BATCH_MAX_XFERS ||
+			b->n_bytes + n_tx > SPI_BATCH_MAX_BYTES) {
+		ret = spi_batch_send(spi->id_no & 1);
+		if (ret < 0)
+			return ret;
 	}
 
-	struct spi_ioc_transfer tr[2] = {
-		{
-			.tx_buf = (unsigned long)txbuf,
-			.len = n_tx,
-		}, {
-			.rx_buf = (unsigned long)rxbuf,
-			.len = n_rx,
-		},
-	};
-
-	if (spi->id_no == 0) {
-		ret = ioctl(spidev_fd, SPI_IOC_MESSAGE(2), &tr);
-		if (ret == 1) {
-			printf("%s: Can't send spi message\n\r", __func__);
-			return -EIO;
-		}
+	tr = &b->xfers[b->n_xfers];
+	memset(tr, 0, sizeof(*tr) * 2);
+	if (n_tx <= SPI_BATCH_MAX_BYTES) {
+		/* queued commands must not refer to the caller's buffer */
+		memcpy(&b->buf[b->n_bytes], txbuf, n_tx);
+		tr[0].tx_buf = (unsigned long)&b->buf[b->n_bytes];
+		b->n_bytes += n_tx;
 	} else {
-#ifdef FMCOMMS5
-		ret = ioctl(spidev_b_fd, SPI_IOC_MESSAGE(2), &tr);
-		if (ret == 1) {
-			printf("%s: Can't send spi message\n\r", __func__);
-			return -EIO;
-		}
-#endif
+		tr[0].tx_buf = (unsigned long)txbuf;
+	}
+	tr[0].len = n_tx;
+	tr[0].cs_change = (n_rx == 0);
+	b->n_xfers++;
+	if (n_rx > 0) {
+		/* chip select stays asserted between command and data */
+		tr[1].rx_buf = (unsigned long)rxbuf;
+		tr[1].len = n_rx;
+		tr[1].cs_change = 1;
+		b->n_xfers++;
 	}
 
-	return ret;
+	if (b->depth > 0 && n_rx == 0 && n_tx <= SPI_BATCH_MAX_BYTES)
+		return 0;
+
+	/* not batching, or a read: send the queue including this command */
+	return spi_batch_send(spi->id_no & 1);
 }
 
 /***************************************************************************//**
@@ -285,6 +381,7 @@ void gpio_set_value(unsigned gpio, int value)
 *******************************************************************************/
 void udelay(unsigned long usecs)
 {
+	spi_batch_flush_all();
 	usleep(usecs);
 }
 
@@ -293,6 +390,7 @@ void udelay(unsigned long usecs)
 *******************************************************************************/
 void mdelay(unsigned long msecs)
 {
+	spi_batch_flush_all();
 	usleep(msecs * 1000);
 }
 
@@ -301,6 +399,7 @@ void mdelay(unsigned long msecs)
 *******************************************************************************/
 unsigned long msleep_interruptible(unsigned int msecs)
 {
+	spi_batch_flush_all();
 	usleep(msecs * 1000);
 	return 0;
 }
@@ -142,6 +142,8 @@ int32_t spi_init(uint32_t device_id,
 int spi_write_then_read(struct spi_device *spi,
 		const unsigned char *txbuf, unsigned n_tx,
 		unsigned char *rxbuf, unsigned n_rx);
+void spi_batch_begin(struct spi_device *spi);
+int spi_batch_end(struct spi_device *spi);
 void gpio_init(uint32_t device_id);
 void gpio_direction(uint16_t pin, uint8_t direction);
 bool gpio_is_valid(int number);
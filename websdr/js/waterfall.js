@@ -0,0 +1,62 @@
+// waterfall display; new rows are added at the top and older rows scroll down.
+// the x extents follow the zoom of an associated Oscilloscope.
+function Waterfall(canvas, osc) {
+	this.canvas=canvas;
+	this.osc=osc;
+	if(window.devicePixelRatio==null)this.pr=1;
+	else this.pr=window.devicePixelRatio;
+
+	// returns a css color for a value between 0 and 255
+	this.colorMap = function(v) {
+		var r = Math.min(255, Math.max(0, (v - 128) * 2));
+		var g = Math.min(255, Math.max(0, v < 128 ? v * 2 : (255 - v) * 2 + 64));
+		var b = Math.min(255, Math.max(0, 255 - v * 2));
+		return [r, g, b];
+	};
+
+	this.resize = function() {
+		var w = this.canvas.clientWidth*this.pr;
+		var h = this.canvas.clientHeight*this.pr;
+		if(this.canvas.width != w || this.canvas.height != h) {
+			this.canvas.width = w;
+			this.canvas.height = h;
+		}
+	};
+
+	// add one row. values holds one value (0-255) per point; the first point
+	// is at hw sample dataLeft and each point covers dataWidth hw samples.
+	this.addRow = function(values, dataLeft, dataWidth) {
+		this.resize();
+		var w = this.canvas.width, h = this.canvas.height;
+		if(w == 0 || h == 0) return;
+		var gc = this.canvas.getContext("2d");
+
+		// scroll down by one pixel
+		gc.drawImage(this.canvas, 0, 0, w, h - 1, 0, 1, w, h - 1);
+
+		// the hw sample range that is visible in the oscilloscope
+		var ext = this.osc.zoomDataExtents();
+		var img = gc.createImageData(w, 1);
+		for(var x=0; x<w; x++) {
+			var s1 = ext[0] + (ext[1] - ext[0]) * x / w;
+			var s2 = ext[0] + (ext[1] - ext[0]) * (x + 1) / w;
+			var i1 = Math.floor((s1 - dataLeft) / dataWidth);
+			var i2 = Math.max(i1, Math.ceil((s2 - dataLeft) / dataWidth) - 1);
+			var v = -1;
+			for(var i=Math.max(i1, 0); i<=i2 && i<values.length; i++)
+				if(values[i] > v) v = values[i];
+			var c = (v < 0) ? [255, 255, 255] : this.colorMap(v);
+			img.data[x*4] = c[0];
+			img.data[x*4 + 1] = c[1];
+			img.data[x*4 + 2] = c[2];
+			img.data[x*4 + 3] = 255;
+		}
+		gc.putImageData(img, 0, 0);
+	};
+
+	// clear the display, e.g. after the view has changed
+	this.clear = function() {
+		this.resize();
+		this.canvas.getContext("2d").clearRect(0, 0, this.canvas.width, this.canvas.height);
+	};
+}